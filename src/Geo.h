@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Geodesy and lat/lon grid helpers shared by Player, the geofences
+ * and the proximity engine.
+ *
+ * The grid is made of 1 degree cells.  Columns may be given "unwrapped"
+ * (outside of [0, 360)) and are wrapped when a cell key is made, so a
+ * range of columns can run across the anti-meridian.
+ */
+namespace geo
+{
+    const double EARTH_RADIUS_KM = 6371.0;
+    const double KM_PER_DEG = EARTH_RADIUS_KM * M_PI / 180.0;
+
+    const int GRID_ROWS = 180;
+    const int GRID_COLS = 360;
+
+    /// returns lon shifted by a multiple of 360 so that it is within 180 degrees of ref
+    inline double alignLon(const double lon, const double ref)
+    {
+        return lon + 360.0 * std::round((ref - lon) / 360.0);
+    }
+
+    /// great circle distance in kilometers
+    inline double haversineKm(const double lat0Deg, const double lon0Deg, const double lat1Deg, const double lon1Deg)
+    {
+        double lat0 = lat0Deg * M_PI / 180.0;
+        double lat1 = lat1Deg * M_PI / 180.0;
+        double dLat = lat1 - lat0;
+        double dLon = (lon1Deg - lon0Deg) * M_PI / 180.0;
+
+        double a = sin(dLat / 2) * sin(dLat / 2) + cos(lat0) * cos(lat1) * sin(dLon / 2) * sin(dLon / 2);
+        return 2 * EARTH_RADIUS_KM * atan2(sqrt(a), sqrt(1 - a));
+    }
+
+    inline int gridRow(const double latDeg)
+    {
+        return std::clamp(static_cast<int>(std::floor(latDeg + 90.0)), 0, GRID_ROWS - 1);
+    }
+
+    /// the column of an unwrapped longitude, before wrapping
+    inline int gridColUnwrapped(const double lonDeg)
+    {
+        return static_cast<int>(std::floor(lonDeg + 180.0));
+    }
+
+    inline int gridKey(const int row, const int colUnwrapped)
+    {
+        int col = ((colUnwrapped % GRID_COLS) + GRID_COLS) % GRID_COLS;
+        return row * GRID_COLS + col;
+    }
+
+    inline int gridCell(const double latDeg, const double lonDeg)
+    {
+        return gridKey(gridRow(latDeg), gridColUnwrapped(lonDeg));
+    }
+}
@@ -0,0 +1,706 @@
+#include <fmt/core.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "rapidjson/document.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/error/en.h"
+
+#include "Geo.h"
+#include "Geofence.h"
+
+namespace
+{
+    /// 2d cross product of (b - a) and (c - a)
+    double orient(const double ax, const double ay, const double bx, const double by, const double cx, const double cy)
+    {
+        return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+    }
+
+    /// fraction of the way along segment ab of p's projection onto it
+    double paramOn(const double ax, const double ay, const double bx, const double by, const double px, const double py)
+    {
+        double len2 = (bx - ax) * (bx - ax) + (by - ay) * (by - ay);
+        return (len2 == 0.0) ? 0.0 : std::clamp(((px - ax) * (bx - ax) + (py - ay) * (by - ay)) / len2, 0.0, 1.0);
+    }
+
+    /// returns true if segment ab and segment cd touch, and sets tMin/tMax
+    /// to the range of fractions along ab where they touch
+    bool segmentContact(
+        const double ax, const double ay, const double bx, const double by,
+        const double cx, const double cy, const double dx, const double dy,
+        double &tMin, double &tMax)
+    {
+        double d1 = orient(cx, cy, dx, dy, ax, ay);
+        double d2 = orient(cx, cy, dx, dy, bx, by);
+        double d3 = orient(ax, ay, bx, by, cx, cy);
+        double d4 = orient(ax, ay, bx, by, dx, dy);
+
+        if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+        {
+            tMin = tMax = d1 / (d1 - d2);
+            return true;
+        }
+
+        // collinear cases
+        auto onSegment = [](double px, double py, double qx, double qy, double rx, double ry)
+        {
+            return std::min(px, qx) <= rx && rx <= std::max(px, qx) && std::min(py, qy) <= ry && ry <= std::max(py, qy);
+        };
+
+        bool touched = false;
+        tMin = 1.0;
+        tMax = 0.0;
+        auto touch = [&](double t)
+        {
+            touched = true;
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        };
+        if (d1 == 0 && onSegment(cx, cy, dx, dy, ax, ay))
+        {
+            touch(0.0);
+        }
+        if (d2 == 0 && onSegment(cx, cy, dx, dy, bx, by))
+        {
+            touch(1.0);
+        }
+        if (d3 == 0 && onSegment(ax, ay, bx, by, cx, cy))
+        {
+            touch(paramOn(ax, ay, bx, by, cx, cy));
+        }
+        if (d4 == 0 && onSegment(ax, ay, bx, by, dx, dy))
+        {
+            touch(paramOn(ax, ay, bx, by, dx, dy));
+        }
+        return touched;
+    }
+
+    /// calls f with the key of every grid cell a fence's bounding box touches
+    template <typename F>
+    void forEachCell(const Geofence &fence, F f)
+    {
+        int colMin = geo::gridColUnwrapped(fence.minLon);
+        int colMax = std::min(geo::gridColUnwrapped(fence.maxLon), colMin + geo::GRID_COLS - 1);
+        for (int row = geo::gridRow(fence.minLat); row <= geo::gridRow(fence.maxLat); row++)
+        {
+            for (int col = colMin; col <= colMax; col++)
+            {
+                f(geo::gridKey(row, col));
+            }
+        }
+    }
+
+    double getNumber(const rapidjson::Value &v, const char *what)
+    {
+        if (!v.IsNumber())
+        {
+            throw std::invalid_argument(fmt::format("Invalid data types in geofence {}", what));
+        }
+        return v.GetDouble();
+    }
+
+    Geofence parseFeature(const rapidjson::Value &feature, const size_t index)
+    {
+        if (!feature.IsObject() || !feature.HasMember("geometry") || !feature["geometry"].IsObject())
+        {
+            throw std::invalid_argument("Geofence feature has no geometry");
+        }
+
+        std::string name = fmt::format("geofence-{}", index);
+        const rapidjson::Value *properties = nullptr;
+        if (feature.HasMember("properties") && feature["properties"].IsObject())
+        {
+            properties = &feature["properties"];
+            if (properties->HasMember("name") && (*properties)["name"].IsString())
+            {
+                name = (*properties)["name"].GetString();
+            }
+        }
+
+        const rapidjson::Value &geometry = feature["geometry"];
+        if (!geometry.HasMember("type") || !geometry["type"].IsString() || !geometry.HasMember("coordinates"))
+        {
+            throw std::invalid_argument(fmt::format("Geofence \"{}\" has an invalid geometry", name));
+        }
+
+        std::string type = geometry["type"].GetString();
+        const rapidjson::Value &coordinates = geometry["coordinates"];
+
+        if (type == "Polygon")
+        {
+            // only the outer ring is used
+            if (!coordinates.IsArray() || coordinates.Empty() || !coordinates[0].IsArray())
+            {
+                throw std::invalid_argument(fmt::format("Geofence \"{}\" has invalid polygon coordinates", name));
+            }
+
+            std::vector<std::tuple<double, double>> ring;
+            for (const auto &position : coordinates[0].GetArray())
+            {
+                if (!position.IsArray() || position.Size() < 2)
+                {
+                    throw std::invalid_argument(fmt::format("Geofence \"{}\" has invalid polygon coordinates", name));
+                }
+                ring.emplace_back(getNumber(position[1], "latitude"), getNumber(position[0], "longitude"));
+            }
+            return Geofence::polygon(name, ring);
+        }
+        else if (type == "Point")
+        {
+            if (!coordinates.IsArray() || coordinates.Size() < 2)
+            {
+                throw std::invalid_argument(fmt::format("Geofence \"{}\" has invalid point coordinates", name));
+            }
+            if (!properties || !properties->HasMember("radius_km"))
+            {
+                throw std::invalid_argument(fmt::format("Geofence \"{}\" is a Point without a radius_km property", name));
+            }
+            return Geofence::circle(
+                name,
+                getNumber(coordinates[1], "latitude"),
+                getNumber(coordinates[0], "longitude"),
+                getNumber((*properties)["radius_km"], "radius_km"));
+        }
+
+        throw std::invalid_argument(fmt::format("Geofence \"{}\" has unsupported geometry type {}", name, type));
+    }
+}
+
+Geofence Geofence::polygon(const std::string &fenceName, const std::vector<std::tuple<double, double>> &ring)
+{
+    Geofence fence;
+    fence.name = fenceName;
+    fence.shape = Shape::Polygon;
+
+    for (const auto &[lat, lon] : ring)
+    {
+        double unwrapped = fence.vertices.empty() ? lon : geo::alignLon(lon, std::get<1>(fence.vertices.back()));
+        fence.vertices.emplace_back(lat, unwrapped);
+    }
+
+    // drop the closing vertex
+    if (fence.vertices.size() > 1)
+    {
+        auto [firstLat, firstLon] = fence.vertices.front();
+        auto [lastLat, lastLon] = fence.vertices.back();
+        if (firstLat == lastLat && std::fabs(firstLon - lastLon) < 1e-9)
+        {
+            fence.vertices.pop_back();
+        }
+    }
+
+    if (fence.vertices.size() < 3)
+    {
+        throw std::invalid_argument(fmt::format("Geofence \"{}\" needs at least 3 vertices", fenceName));
+    }
+
+    fence.minLat = fence.maxLat = std::get<0>(fence.vertices.front());
+    fence.minLon = fence.maxLon = std::get<1>(fence.vertices.front());
+    for (const auto &[lat, lon] : fence.vertices)
+    {
+        if (lat < -90.0 || lat > 90.0)
+        {
+            throw std::invalid_argument(fmt::format("Geofence \"{}\" latitude value ({}) is out of range", fenceName, lat));
+        }
+        fence.minLat = std::min(fence.minLat, lat);
+        fence.maxLat = std::max(fence.maxLat, lat);
+        fence.minLon = std::min(fence.minLon, lon);
+        fence.maxLon = std::max(fence.maxLon, lon);
+    }
+    return fence;
+}
+
+Geofence Geofence::circle(const std::string &fenceName, const double latDeg, const double lonDeg, const double kmRadius)
+{
+    if (latDeg < -90.0 || latDeg > 90.0)
+    {
+        throw std::invalid_argument(fmt::format("Geofence \"{}\" latitude value ({}) is out of range", fenceName, latDeg));
+    }
+    if (kmRadius <= 0.0)
+    {
+        throw std::invalid_argument(fmt::format("Geofence \"{}\" radius ({}) must be greater than 0", fenceName, kmRadius));
+    }
+
+    Geofence fence;
+    fence.name = fenceName;
+    fence.shape = Shape::Circle;
+    fence.centerLat = latDeg;
+    fence.centerLon = lonDeg;
+    fence.radiusKm = kmRadius;
+
+    double dLat = kmRadius / geo::KM_PER_DEG;
+    fence.minLat = std::max(-90.0, latDeg - dLat);
+    fence.maxLat = std::min(90.0, latDeg + dLat);
+
+    // the circle is widest at the edge of its bounding box closest to a pole
+    double widestLat = std::max(std::fabs(fence.minLat), std::fabs(fence.maxLat));
+    double dLon = (widestLat >= 90.0) ? 180.0 : dLat / cos(widestLat * M_PI / 180.0);
+    if (dLon >= 180.0)
+    {
+        fence.minLon = -180.0;
+        fence.maxLon = 180.0;
+    }
+    else
+    {
+        fence.minLon = lonDeg - dLon;
+        fence.maxLon = lonDeg + dLon;
+    }
+    return fence;
+}
+
+bool Geofence::contains(const double latDeg, const double lonDeg) const
+{
+    if (shape == Shape::Circle)
+    {
+        return geo::haversineKm(centerLat, centerLon, latDeg, lonDeg) <= radiusKm;
+    }
+
+    double lon = geo::alignLon(lonDeg, (minLon + maxLon) / 2.0);
+    if (latDeg < minLat || latDeg > maxLat || lon < minLon || lon > maxLon)
+    {
+        return false;
+    }
+
+    // ray casting
+    bool inside = false;
+    for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+    {
+        auto [latI, lonI] = vertices[i];
+        auto [latJ, lonJ] = vertices[j];
+        if (((latI > latDeg) != (latJ > latDeg)) &&
+            (lon < (lonJ - lonI) * (latDeg - latI) / (latJ - latI) + lonI))
+        {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+bool Geofence::intersects(const double lat0Deg, const double lon0Deg, const double lat1Deg, const double lon1Deg) const
+{
+    return contains(lat0Deg, lon0Deg) || contains(lat1Deg, lon1Deg) ||
+           !crossings(lat0Deg, lon0Deg, lat1Deg, lon1Deg).empty();
+}
+
+std::vector<double> Geofence::crossings(const double lat0Deg, const double lon0Deg, const double lat1Deg, const double lon1Deg) const
+{
+    std::vector<double> ts;
+
+    if (shape == Shape::Circle)
+    {
+        // solve in a plane tangent at the center, in kilometers
+        double lon0 = geo::alignLon(lon0Deg, centerLon);
+        double lon1 = geo::alignLon(lon1Deg, lon0);
+        double scale = cos(centerLat * M_PI / 180.0) * geo::KM_PER_DEG;
+
+        double x0 = (lon0 - centerLon) * scale;
+        double y0 = (lat0Deg - centerLat) * geo::KM_PER_DEG;
+        double dx = (lon1 - lon0) * scale;
+        double dy = (lat1Deg - lat0Deg) * geo::KM_PER_DEG;
+
+        double a = dx * dx + dy * dy;
+        double b = 2.0 * (x0 * dx + y0 * dy);
+        double c = x0 * x0 + y0 * y0 - radiusKm * radiusKm;
+        double disc = b * b - 4.0 * a * c;
+        if (a == 0.0 || disc < 0.0)
+        {
+            return ts;
+        }
+
+        for (double t : {(-b - sqrt(disc)) / (2.0 * a), (-b + sqrt(disc)) / (2.0 * a)})
+        {
+            if (t >= 0.0 && t <= 1.0)
+            {
+                ts.push_back(t);
+            }
+        }
+        return ts;
+    }
+
+    double lon0 = geo::alignLon(lon0Deg, (minLon + maxLon) / 2.0);
+    double lon1 = geo::alignLon(lon1Deg, lon0);
+    if (std::max(lat0Deg, lat1Deg) < minLat || std::min(lat0Deg, lat1Deg) > maxLat ||
+        std::max(lon0, lon1) < minLon || std::min(lon0, lon1) > maxLon)
+    {
+        return ts;
+    }
+
+    for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+    {
+        auto [latI, lonI] = vertices[i];
+        auto [latJ, lonJ] = vertices[j];
+        double tMin, tMax;
+        if (segmentContact(lon0, lat0Deg, lon1, lat1Deg, lonI, latI, lonJ, latJ, tMin, tMax))
+        {
+            ts.push_back(tMin);
+            if (tMax != tMin)
+            {
+                ts.push_back(tMax);
+            }
+        }
+    }
+
+    std::sort(ts.begin(), ts.end());
+    ts.erase(std::unique(ts.begin(), ts.end()), ts.end());
+    return ts;
+}
+
+const std::string GeofenceEvent::toGeoJSON() const
+{
+    rapidjson::Document document;
+    document.SetObject();
+    rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
+
+    document.AddMember("type", "Feature", allocator);
+
+    rapidjson::Value geometry(rapidjson::kObjectType);
+    geometry.AddMember("type", "Point", allocator);
+
+    rapidjson::Value coordinates(rapidjson::kArrayType);
+    coordinates.PushBack(lon, allocator);
+    coordinates.PushBack(lat, allocator);
+    geometry.AddMember("coordinates", coordinates, allocator);
+
+    document.AddMember("geometry", geometry, allocator);
+
+    rapidjson::Value properties(rapidjson::kObjectType);
+    properties.AddMember("name", rapidjson::Value(entity.c_str(), allocator), allocator);
+    properties.AddMember("geofence", rapidjson::Value(fence.c_str(), allocator), allocator);
+    properties.AddMember("event", rapidjson::Value(type.c_str(), allocator), allocator);
+
+    document.AddMember("properties", properties, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.SetMaxDecimalPlaces(5);
+    document.Accept(writer);
+
+    return buffer.GetString();
+}
+
+void GeofenceSet::load(const std::string &geoJsonDoc)
+{
+    rapidjson::Document document;
+    document.Parse(geoJsonDoc.c_str());
+
+    if (document.HasParseError())
+    {
+        std::string error = fmt::format("JSON Parse Error: {} at offset {} ", rapidjson::GetParseError_En(document.GetParseError()), document.GetErrorOffset());
+        fmt::println("{}", error);
+        throw std::invalid_argument(error);
+    }
+
+    if (!document.IsObject() || !document.HasMember("type") || !document["type"].IsString())
+    {
+        std::string error = fmt::format("Invalid geofence document");
+        fmt::println("{}", error);
+        throw std::invalid_argument(error);
+    }
+
+    // parse everything before touching the current fences
+    std::vector<Geofence> fences;
+    std::string type = document["type"].GetString();
+    try
+    {
+        if (type == "FeatureCollection" && document.HasMember("features") && document["features"].IsArray())
+        {
+            for (const auto &feature : document["features"].GetArray())
+            {
+                fences.push_back(parseFeature(feature, fences.size()));
+            }
+        }
+        else if (type == "Feature")
+        {
+            fences.push_back(parseFeature(document, 0));
+        }
+        else
+        {
+            throw std::invalid_argument("Geofence document must be a Feature or a FeatureCollection");
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::println("{}", e.what());
+        throw;
+    }
+
+    // later fences replace earlier ones with the same name
+    std::vector<Geofence> unique;
+    std::unordered_map<std::string, size_t> seen;
+    for (auto &fence : fences)
+    {
+        auto [it, inserted] = seen.try_emplace(fence.name, unique.size());
+        if (inserted)
+        {
+            unique.push_back(std::move(fence));
+        }
+        else
+        {
+            unique[it->second] = std::move(fence);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_fenceMutex);
+    _fences = std::move(unique);
+    reindex();
+}
+
+void GeofenceSet::add(const Geofence &fence)
+{
+    std::lock_guard<std::mutex> lock(_fenceMutex);
+    auto it = _fenceIndex.find(fence.name);
+    if (it != _fenceIndex.end())
+    {
+        unindex(it->second);
+        _fences[it->second] = fence;
+        index(it->second);
+    }
+    else
+    {
+        _fences.push_back(fence);
+        _fenceIndex[fence.name] = _fences.size() - 1;
+        index(_fences.size() - 1);
+    }
+}
+
+void GeofenceSet::remove(const std::string &entity)
+{
+    std::lock_guard<std::mutex> lock(_fenceMutex);
+    _inside.erase(entity);
+    _removedInside.erase(entity);
+}
+
+void GeofenceSet::clear()
+{
+    std::lock_guard<std::mutex> lock(_fenceMutex);
+    _fences.clear();
+    reindex();
+}
+
+size_t GeofenceSet::size()
+{
+    std::lock_guard<std::mutex> lock(_fenceMutex);
+    return _fences.size();
+}
+
+const std::string GeofenceSet::toJson()
+{
+    std::lock_guard<std::mutex> lock(_fenceMutex);
+
+    rapidjson::Document document;
+    document.SetObject();
+    rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
+
+    rapidjson::Value fences(rapidjson::kArrayType);
+    for (const auto &fence : _fences)
+    {
+        rapidjson::Value f(rapidjson::kObjectType);
+        f.AddMember("name", rapidjson::Value(fence.name.c_str(), allocator), allocator);
+        f.AddMember("type", rapidjson::StringRef(fence.shape == Geofence::Shape::Circle ? "Circle" : "Polygon"), allocator);
+        fences.PushBack(f, allocator);
+    }
+    document.AddMember("geofences", fences, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    document.Accept(writer);
+    return buffer.GetString();
+}
+
+std::vector<GeofenceEvent> GeofenceSet::update(
+    const std::string &entity,
+    const double prevLat,
+    const double prevLon,
+    const double lat,
+    const double lon)
+{
+    std::lock_guard<std::mutex> lock(_fenceMutex);
+    std::vector<GeofenceEvent> events;
+
+    // exits from fences that were removed since the entity's last update
+    auto removed = _removedInside.find(entity);
+    if (removed != _removedInside.end())
+    {
+        for (const auto &fenceName : removed->second)
+        {
+            events.push_back({entity, fenceName, "exit", prevLat, prevLon});
+        }
+        _removedInside.erase(removed);
+    }
+
+    if (_fences.empty())
+    {
+        _inside.erase(entity);
+        return events;
+    }
+
+    // only entities inside at least one fence are kept in _inside
+    auto state = _inside.find(entity);
+    std::set<std::string> inside = (state != _inside.end()) ? std::move(state->second) : std::set<std::string>();
+
+    // every fence whose cells the movement's bounding box touches...
+    double lon1 = geo::alignLon(lon, prevLon);
+    int rowMin = geo::gridRow(std::min(prevLat, lat));
+    int rowMax = geo::gridRow(std::max(prevLat, lat));
+    int colMin = geo::gridColUnwrapped(std::min(prevLon, lon1));
+    int colMax = std::min(geo::gridColUnwrapped(std::max(prevLon, lon1)), colMin + geo::GRID_COLS - 1);
+
+    std::vector<size_t> candidates;
+    for (int row = rowMin; row <= rowMax; row++)
+    {
+        for (int col = colMin; col <= colMax; col++)
+        {
+            auto cell = _grid.find(geo::gridKey(row, col));
+            if (cell != _grid.end())
+            {
+                candidates.insert(candidates.end(), cell->second.begin(), cell->second.end());
+            }
+        }
+    }
+
+    // ...plus every fence the entity is already inside
+    for (const auto &fenceName : inside)
+    {
+        auto it = _fenceIndex.find(fenceName);
+        if (it != _fenceIndex.end())
+        {
+            candidates.push_back(it->second);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // the point a fraction of the way along the movement
+    auto pointAt = [&](double t) -> std::tuple<double, double>
+    {
+        return {prevLat + t * (lat - prevLat), geo::alignLon(prevLon + t * (lon1 - prevLon), 0.0)};
+    };
+
+    for (size_t index : candidates)
+    {
+        const Geofence &fence = _fences[index];
+        bool wasInside = inside.count(fence.name) > 0;
+        bool isInside = fence.contains(lat, lon);
+
+        // split the movement where it touches the fence's boundary, and
+        // emit an event wherever the piece after a split is on the other
+        // side from the piece before it
+        std::vector<double> ts = fence.crossings(prevLat, prevLon, lat, lon);
+        bool state = wasInside;
+        double lastT = 0.0;
+        auto transition = [&](bool in, double t)
+        {
+            auto [eventLat, eventLon] = pointAt(t);
+            events.push_back({entity, fence.name, in ? "enter" : "exit", eventLat, eventLon});
+            state = in;
+        };
+
+        for (size_t k = 0; k < ts.size(); k++)
+        {
+            double next = (k + 1 < ts.size()) ? ts[k + 1] : 1.0;
+            if (next <= ts[k])
+            {
+                continue;
+            }
+
+            auto [midLat, midLon] = pointAt((ts[k] + next) / 2.0);
+            bool in = (next == 1.0) ? isInside : fence.contains(midLat, midLon);
+            if (in != state)
+            {
+                transition(in, ts[k]);
+            }
+            lastT = ts[k];
+        }
+
+        // the end of the movement decides, e.g. when it ends on the boundary
+        if (isInside != state)
+        {
+            transition(isInside, ts.empty() ? 1.0 : lastT);
+        }
+
+        if (isInside)
+        {
+            inside.insert(fence.name);
+        }
+        else
+        {
+            inside.erase(fence.name);
+        }
+    }
+
+    if (inside.empty())
+    {
+        if (state != _inside.end())
+        {
+            _inside.erase(state);
+        }
+    }
+    else if (state != _inside.end())
+    {
+        state->second = std::move(inside);
+    }
+    else
+    {
+        _inside.emplace(entity, std::move(inside));
+    }
+    return events;
+}
+
+void GeofenceSet::reindex()
+{
+    _fenceIndex.clear();
+    _grid.clear();
+
+    for (size_t i = 0; i < _fences.size(); i++)
+    {
+        _fenceIndex[_fences[i].name] = i;
+        index(i);
+    }
+
+    // entities inside fences that no longer exist get an exit on their next update
+    for (auto state = _inside.begin(); state != _inside.end();)
+    {
+        std::set<std::string> &inside = state->second;
+        for (auto it = inside.begin(); it != inside.end();)
+        {
+            if (_fenceIndex.count(*it))
+            {
+                ++it;
+                continue;
+            }
+            _removedInside[state->first].push_back(*it);
+            it = inside.erase(it);
+        }
+        state = inside.empty() ? _inside.erase(state) : std::next(state);
+    }
+}
+
+void GeofenceSet::index(const size_t fenceIndex)
+{
+    forEachCell(_fences[fenceIndex], [&](int key)
+    {
+        _grid[key].push_back(fenceIndex);
+    });
+}
+
+void GeofenceSet::unindex(const size_t fenceIndex)
+{
+    forEachCell(_fences[fenceIndex], [&](int key)
+    {
+        auto cell = _grid.find(key);
+        if (cell == _grid.end())
+        {
+            return;
+        }
+        auto &indices = cell->second;
+        indices.erase(std::remove(indices.begin(), indices.end(), fenceIndex), indices.end());
+        if (indices.empty())
+        {
+            _grid.erase(cell);
+        }
+    });
+}
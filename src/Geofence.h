@@ -0,0 +1,191 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Geofence is a named region on the surface of the Earth.  It is either
+ * a polygon (a ring of lat/lon vertices) or a circle (a center and a
+ * radius in kilometers).
+ *
+ * Polygon vertices are stored "unwrapped": consecutive longitudes never
+ * differ by more than 180 degrees, so a fence that crosses the
+ * anti-meridian has longitudes outside of [-180, 180].  Polygons that
+ * enclose a pole are not supported.
+ */
+class Geofence
+{
+public:
+    enum class Shape
+    {
+        Polygon,
+        Circle
+    };
+
+    std::string name;
+    Shape shape = Shape::Polygon;
+
+    /// @brief  polygon ring as (lat, lon) pairs, not closed
+    std::vector<std::tuple<double, double>> vertices;
+
+    /// @brief  circle center and radius
+    double centerLat = 0.0;
+    double centerLon = 0.0;
+    double radiusKm = 0.0;
+
+    /// @brief  bounding box, minLon/maxLon are unwrapped
+    double minLat = 0.0;
+    double maxLat = 0.0;
+    double minLon = 0.0;
+    double maxLon = 0.0;
+
+    /**
+     * creates a polygon fence from a ring of (lat, lon) vertices.
+     * A closing vertex equal to the first one is dropped.
+     */
+    static Geofence polygon(const std::string &fenceName, const std::vector<std::tuple<double, double>> &ring);
+
+    /**
+     * creates a circular fence
+     */
+    static Geofence circle(const std::string &fenceName, const double latDeg, const double lonDeg, const double kmRadius);
+
+    /**
+     * returns true if the point is inside the fence
+     */
+    bool contains(const double latDeg, const double lonDeg) const;
+
+    /**
+     * returns true if any part of the segment between the two points
+     * is inside the fence.  The segment is the short way around the
+     * globe between its endpoints.
+     */
+    bool intersects(const double lat0Deg, const double lon0Deg, const double lat1Deg, const double lon1Deg) const;
+
+    /**
+     * returns the sorted fractions of the way along the segment between
+     * the two points where it touches the fence's boundary.  Touches that
+     * do not cross the boundary, such as passing through a vertex, may
+     * be included.
+     */
+    std::vector<double> crossings(const double lat0Deg, const double lon0Deg, const double lat1Deg, const double lon1Deg) const;
+};
+
+/**
+ * GeofenceEvent records an entity entering or exiting a Geofence.
+ */
+class GeofenceEvent
+{
+public:
+    std::string entity;
+    std::string fence;
+    std::string type; // "enter" or "exit"
+    double lat = 0.0;
+    double lon = 0.0;
+
+    /**
+     * returns the event as a geojson doc
+     */
+    const std::string toGeoJSON() const;
+};
+
+/**
+ * GeofenceSet holds the loaded geofences in a 1 degree lat/lon grid
+ * and tracks which fences each entity is inside.
+ *
+ * Entities are checked incrementally: each call to update() looks at
+ * the segment between the entity's previous and new position, so an
+ * entity that moves far enough in one step to jump over a fence still
+ * produces an enter/exit pair.
+ */
+class GeofenceSet
+{
+public:
+    /**
+     * Replaces the fences with those in a GeoJSON Feature or
+     * FeatureCollection.  Polygon features become polygon fences and
+     * Point features with a "radius_km" property become circles.  The
+     * fence name is taken from the "name" property.
+     *
+     * @param geoJsonDoc the GeoJSON document
+     * @throws std::invalid_argument if the document can not be used
+     */
+    void load(const std::string &geoJsonDoc);
+
+    /**
+     * adds a single fence, replacing any fence with the same name.
+     * Only the grid cells the fence touches are updated.
+     */
+    void add(const Geofence &fence);
+
+    /**
+     * forgets which fences an entity is inside, including any exits
+     * that are waiting for its next update
+     */
+    void remove(const std::string &entity);
+
+    /**
+     * removes all fences
+     */
+    void clear();
+
+    /**
+     * returns the number of fences loaded
+     */
+    size_t size();
+
+    /**
+     * returns the names and shapes of the loaded fences as a JSON document
+     */
+    const std::string toJson();
+
+    /**
+     * Moves an entity from its previous position to its new position
+     * and returns the enter/exit events caused by the move.  Each event
+     * is stamped with the point where the move crosses the fence.
+     *
+     * An entity that was inside a fence that has since been removed or
+     * cleared gets an exit for it, stamped with its previous position.
+     *
+     * @param entity the entity's name
+     * @param prevLat the entity's latitude before the move
+     * @param prevLon the entity's longitude before the move
+     * @param lat the entity's latitude after the move
+     * @param lon the entity's longitude after the move
+     */
+    std::vector<GeofenceEvent> update(
+        const std::string &entity,
+        const double prevLat,
+        const double prevLon,
+        const double lat,
+        const double lon);
+
+protected:
+    std::mutex _fenceMutex;
+
+    std::vector<Geofence> _fences;
+    std::unordered_map<std::string, size_t> _fenceIndex;
+
+    /// grid cell -> indices of the fences whose bounding box touch the cell
+    std::unordered_map<int, std::vector<size_t>> _grid;
+
+    /// entity name -> names of the fences the entity is inside, only
+    /// entities that are inside at least one fence are kept
+    std::map<std::string, std::set<std::string>> _inside;
+
+    /// entity name -> names of removed fences the entity was inside,
+    /// reported as exits on the entity's next update
+    std::map<std::string, std::vector<std::string>> _removedInside;
+
+    /// rebuilds _fenceIndex and _grid from _fences
+    void reindex();
+
+    /// adds/removes one fence to/from the grid cells its bounding box touches
+    void index(const size_t fenceIndex);
+    void unindex(const size_t fenceIndex);
+};
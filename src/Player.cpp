@@ -7,6 +7,7 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/error/en.h"
 
+#include "Geo.h"
 #include "Player.h"
 
 Player::Player() {}
@@ -88,6 +89,12 @@ const std::string Player::toGeoJSON()
     return buffer.GetString();
 }
 
+std::tuple<double, double, double, double> Player::snapshot()
+{
+    std::lock_guard<std::mutex> lock(_playerMutex);
+    return {lat, lon, bearing, kph};
+}
+
 void Player::travel(const double hours)
 {
     std::lock_guard<std::mutex> lock(_playerMutex);
@@ -133,7 +140,7 @@ std::tuple<double, double> Player::calculateDestination(
     const double &speedKPH,
     const double &timeH)
 {
-    const double R = 6371.0; // Earth's radius in kilometers
+    const double R = geo::EARTH_RADIUS_KM;
 
     // Convert degrees to radians
     double beginLat = beginLatDeg * M_PI / 180.0;
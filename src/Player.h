@@ -62,6 +62,13 @@ public:
      */
     const std::string toGeoJSON();
 
+    /**
+     * returns the player's location and velocity vector, read together
+     *
+     * @return lat, lon, bearing and kph in a tuple
+     */
+    std::tuple<double, double, double, double> snapshot();
+
     /**
      * calculates where the player would be after traveling
      * at its bearing and speed for the provided number of hours,
@@ -93,9 +100,6 @@ public:
      */
     void updateVelocity(const double bearingDegrees, const double speedKph);
 
-protected:
-    std::mutex _playerMutex;
-
     /// Given a location, a velocity vector, and a time...
     /// calculate how far the player would travel in timeH at speedKPH.
     /// Then calculate where the player would be if it followed
@@ -103,10 +107,13 @@ protected:
     /// its initial bearing.
     ///
     /// @return a lat/lon of the final coords in a tuple
-    std::tuple<double, double> calculateDestination(
+    static std::tuple<double, double> calculateDestination(
         const double &beginLatDeg,
         const double &beginLonDeg,
         const double &bearingDeg,
         const double &speedKPH,
         const double &timeH);
+
+protected:
+    std::mutex _playerMutex;
 };
\ No newline at end of file
@@ -0,0 +1,468 @@
+#include <fmt/core.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "rapidjson/document.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/error/en.h"
+
+#include "Geo.h"
+#include "Player.h"
+#include "Proximity.h"
+
+namespace
+{
+    std::pair<std::string, std::string> pairKey(const std::string &a, const std::string &b)
+    {
+        return a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+    }
+
+    void addAlert(rapidjson::Value &target, const ProximityAlert &alert, rapidjson::Document::AllocatorType &allocator)
+    {
+        rapidjson::Value names(rapidjson::kArrayType);
+        names.PushBack(rapidjson::Value(alert.entityA.c_str(), allocator), allocator);
+        names.PushBack(rapidjson::Value(alert.entityB.c_str(), allocator), allocator);
+        target.AddMember("names", names, allocator);
+        target.AddMember("tcpa_min", alert.tcpaMin, allocator);
+        target.AddMember("dcpa_km", alert.dcpaKm, allocator);
+    }
+}
+
+const std::string ProximityAlert::toJson() const
+{
+    rapidjson::Document document;
+    document.SetObject();
+    rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
+
+    document.AddMember("alert", "proximity", allocator);
+    addAlert(document, *this, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.SetMaxDecimalPlaces(3);
+    document.Accept(writer);
+    return buffer.GetString();
+}
+
+ProximityEngine::ProximityEngine(const double alertKm, const double horizonMin)
+    : _alertKm(alertKm), _horizonH(horizonMin / 60.0)
+{
+}
+
+void ProximityEngine::update(
+    const std::string &entity,
+    const double latDeg,
+    const double lonDeg,
+    const double bearingDeg,
+    const double speedKph)
+{
+    std::lock_guard<std::mutex> lock(_proximityMutex);
+
+    Entity &e = _entities[entity];
+    if (e.bearing != bearingDeg || e.kph != speedKph)
+    {
+        e.dirty = true;
+    }
+
+    e.lat = latDeg;
+    e.lon = lonDeg;
+    e.fixH = _clockH;
+    e.bearing = bearingDeg;
+    e.kph = speedKph;
+    place(entity, e, geo::gridCell(latDeg, lonDeg));
+}
+
+void ProximityEngine::update(const std::string &entityDoc)
+{
+    rapidjson::Document document;
+    document.Parse(entityDoc.c_str());
+
+    if (document.HasParseError())
+    {
+        std::string error = fmt::format("JSON Parse Error: {} at offset {} ", rapidjson::GetParseError_En(document.GetParseError()), document.GetErrorOffset());
+        fmt::println("{}", error);
+        throw std::invalid_argument(error);
+    }
+
+    bool valid = document.IsObject() && document.HasMember("name") && document["name"].IsString();
+    for (const char *member : {"lat", "lon", "bearing", "kph"})
+    {
+        valid = valid && document.HasMember(member) && document[member].IsNumber();
+    }
+
+    if (!valid)
+    {
+        std::string error = fmt::format("Invalid data types in entity document");
+        fmt::println("{}", error);
+        throw std::invalid_argument(error);
+    }
+
+    double lat = document["lat"].GetDouble();
+    double lon = document["lon"].GetDouble();
+    double bearing = document["bearing"].GetDouble();
+    double kph = document["kph"].GetDouble();
+
+    std::string error;
+    if (lat < -90.0 || lat > 90.0)
+    {
+        error = fmt::format("Latitude value ({}) is out of range. It must be in the range (-90.0 , 90.0)", lat);
+    }
+    else if (lon < -180.0 || lon > 180.0)
+    {
+        error = fmt::format("Longitude value ({}) is out of range. It must be in the range [-180.0 , 180.0)", lon);
+    }
+    else if (bearing < 0.0 || bearing >= 360.0)
+    {
+        error = fmt::format("Bearing value ({}) is out of range. It must be in the range (0.0->360.0]", bearing);
+    }
+    else if (kph < 0.0)
+    {
+        error = fmt::format("Rate value ({}) is out of range.  It must be greater than or equal to 0.", kph);
+    }
+
+    if (!error.empty())
+    {
+        fmt::println("{}", error);
+        throw std::invalid_argument(error);
+    }
+
+    std::string name = document["name"].GetString();
+    bool reserved;
+    {
+        std::lock_guard<std::mutex> lock(_proximityMutex);
+        reserved = _reserved.count(name) > 0;
+    }
+
+    if (reserved)
+    {
+        std::string error = fmt::format("Entity name \"{}\" is reserved", name);
+        fmt::println("{}", error);
+        throw std::invalid_argument(error);
+    }
+
+    update(name, lat, lon, bearing, kph);
+}
+
+void ProximityEngine::reserve(const std::string &entity)
+{
+    std::lock_guard<std::mutex> lock(_proximityMutex);
+    _reserved.insert(entity);
+}
+
+void ProximityEngine::remove(const std::string &entity)
+{
+    std::lock_guard<std::mutex> lock(_proximityMutex);
+    discard(entity);
+}
+
+void ProximityEngine::advance(const double hours)
+{
+    std::lock_guard<std::mutex> lock(_proximityMutex);
+    _clockH += hours;
+}
+
+std::vector<ProximityAlert> ProximityEngine::check()
+{
+    std::lock_guard<std::mutex> lock(_proximityMutex);
+
+    // conflicts up to half a horizon past the horizon are tracked, so a
+    // pair is seen before its conflict is due even if neither entity
+    // changes cell before its periodic recheck
+    const double lookaheadH = 1.5 * _horizonH;
+
+    // drop the entities that have stopped reporting
+    std::vector<std::string> stale;
+    for (const auto &[name, e] : _entities)
+    {
+        if (_clockH - e.fixH > _horizonH)
+        {
+            stale.push_back(name);
+        }
+    }
+    for (const auto &name : stale)
+    {
+        discard(name);
+    }
+
+    // move every entity to the cell it has traveled to
+    double maxKph = 0.0;
+    std::vector<std::string> dirty;
+    for (auto &[name, e] : _entities)
+    {
+        maxKph = std::max(maxKph, e.kph);
+
+        auto [lat, lon] = positionNow(e);
+        place(name, e, geo::gridCell(lat, lon));
+
+        if (_clockH - e.checkedH >= _horizonH / 2.0)
+        {
+            e.dirty = true;
+        }
+        if (e.dirty)
+        {
+            dirty.push_back(name);
+        }
+    }
+
+    // remember which conflicts were already raised so they are not raised twice
+    std::map<std::pair<std::string, std::string>, bool> wasRaised;
+    for (const auto &name : dirty)
+    {
+        auto partners = _partners.find(name);
+        if (partners != _partners.end())
+        {
+            for (const auto &partner : partners->second)
+            {
+                auto key = pairKey(name, partner);
+                wasRaised[key] = _conflicts[key].raised;
+            }
+        }
+        forget(name);
+    }
+
+    std::set<std::string> checked;
+    for (const auto &name : dirty)
+    {
+        Entity &e = _entities[name];
+        auto [lat, lon] = positionNow(e);
+        double eBearing = e.bearing * M_PI / 180.0;
+
+        // broad phase: the cells any entity could reach this entity from within the lookahead
+        double reachDeg = (_alertKm + lookaheadH * (e.kph + maxKph)) / geo::KM_PER_DEG;
+        int row = geo::gridRow(lat);
+        int col = geo::gridColUnwrapped(lon);
+        int dRow = static_cast<int>(std::ceil(reachDeg));
+        double edgeLat = std::fabs(lat) + reachDeg;
+        int dCol = (edgeLat >= 89.0) ? geo::GRID_COLS : static_cast<int>(std::ceil(reachDeg / cos(edgeLat * M_PI / 180.0)));
+        int colMin = col - dCol;
+        int colMax = col + dCol;
+        if (colMax - colMin + 1 >= geo::GRID_COLS)
+        {
+            colMin = 0;
+            colMax = geo::GRID_COLS - 1;
+        }
+
+        for (int r = std::max(0, row - dRow); r <= std::min(geo::GRID_ROWS - 1, row + dRow); r++)
+        {
+            for (int c = colMin; c <= colMax; c++)
+            {
+                auto cell = _grid.find(geo::gridKey(r, c));
+                if (cell == _grid.end())
+                {
+                    continue;
+                }
+
+                for (const auto &otherName : cell->second)
+                {
+                    if (otherName == name || checked.count(otherName))
+                    {
+                        continue;
+                    }
+
+                    // narrow phase: closest point of approach in a plane tangent between the two
+                    const Entity &o = _entities[otherName];
+                    auto [oLat, oLon] = positionNow(o);
+                    double oBearing = o.bearing * M_PI / 180.0;
+
+                    double dx = (geo::alignLon(oLon, lon) - lon) * cos((lat + oLat) / 2.0 * M_PI / 180.0) * geo::KM_PER_DEG;
+                    double dy = (oLat - lat) * geo::KM_PER_DEG;
+                    double dvx = o.kph * sin(oBearing) - e.kph * sin(eBearing);
+                    double dvy = o.kph * cos(oBearing) - e.kph * cos(eBearing);
+
+                    // solve |d + dv * t| = alertKm for the time separation is lost
+                    double a = dvx * dvx + dvy * dvy;
+                    double b = 2.0 * (dx * dvx + dy * dvy);
+                    double c2 = dx * dx + dy * dy - _alertKm * _alertKm;
+
+                    // and for the time it is regained
+                    double enterH = 0.0;
+                    double exitH = std::numeric_limits<double>::infinity();
+                    if (c2 > 0.0)
+                    {
+                        double disc = b * b - 4.0 * a * c2;
+                        if (a == 0.0 || disc < 0.0)
+                        {
+                            continue;
+                        }
+                        enterH = (-b - sqrt(disc)) / (2.0 * a);
+                        if (enterH < 0.0 || enterH > lookaheadH)
+                        {
+                            continue;
+                        }
+                        exitH = (-b + sqrt(disc)) / (2.0 * a);
+                    }
+                    else if (a > 0.0)
+                    {
+                        exitH = (-b + sqrt(b * b - 4.0 * a * c2)) / (2.0 * a);
+                    }
+                    // with no relative motion the conflict lasts until a recheck clears it
+
+                    double tcpaH = (a > 0.0) ? std::max(0.0, -b / (2.0 * a)) : 0.0;
+                    double dcpaKm = std::hypot(dx + dvx * tcpaH, dy + dvy * tcpaH);
+
+                    auto key = pairKey(name, otherName);
+                    Conflict &conflict = _conflicts[key];
+                    conflict.enterH = _clockH + enterH;
+                    conflict.exitH = _clockH + exitH;
+                    conflict.cpaH = _clockH + tcpaH;
+                    conflict.dcpaKm = dcpaKm;
+                    conflict.raised = wasRaised.count(key) ? wasRaised[key] : false;
+                    _partners[name].insert(otherName);
+                    _partners[otherName].insert(name);
+                }
+            }
+        }
+
+        checked.insert(name);
+        e.dirty = false;
+        e.checkedH = _clockH;
+    }
+
+    // drop the conflicts whose separation has been regained and raise the ones that are due
+    std::vector<ProximityAlert> raised;
+    for (auto it = _conflicts.begin(); it != _conflicts.end();)
+    {
+        Conflict &conflict = it->second;
+        if (conflict.exitH < _clockH)
+        {
+            unpair(it->first.first, it->first.second);
+            unpair(it->first.second, it->first.first);
+            it = _conflicts.erase(it);
+            continue;
+        }
+
+        if (!conflict.raised && conflict.enterH - _clockH <= _horizonH)
+        {
+            conflict.raised = true;
+            raised.push_back(toAlert(it->first, conflict));
+        }
+        ++it;
+    }
+    return raised;
+}
+
+std::vector<ProximityAlert> ProximityEngine::alerts()
+{
+    std::lock_guard<std::mutex> lock(_proximityMutex);
+
+    std::vector<ProximityAlert> active;
+    for (const auto &[names, conflict] : _conflicts)
+    {
+        if (conflict.raised)
+        {
+            active.push_back(toAlert(names, conflict));
+        }
+    }
+    return active;
+}
+
+const std::string ProximityEngine::toJson()
+{
+    std::vector<ProximityAlert> active = alerts();
+
+    rapidjson::Document document;
+    document.SetObject();
+    rapidjson::Document::AllocatorType &allocator = document.GetAllocator();
+
+    rapidjson::Value list(rapidjson::kArrayType);
+    for (const auto &alert : active)
+    {
+        rapidjson::Value a(rapidjson::kObjectType);
+        addAlert(a, alert, allocator);
+        list.PushBack(a, allocator);
+    }
+    document.AddMember("alerts", list, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.SetMaxDecimalPlaces(3);
+    document.Accept(writer);
+    return buffer.GetString();
+}
+
+void ProximityEngine::discard(const std::string &name)
+{
+    auto it = _entities.find(name);
+    if (it == _entities.end())
+    {
+        return;
+    }
+
+    forget(name);
+    auto cell = _grid.find(it->second.cell);
+    if (cell != _grid.end())
+    {
+        cell->second.erase(name);
+        if (cell->second.empty())
+        {
+            _grid.erase(cell);
+        }
+    }
+    _entities.erase(it);
+}
+
+void ProximityEngine::place(const std::string &name, Entity &entity, const int cell)
+{
+    if (entity.cell == cell)
+    {
+        return;
+    }
+
+    auto old = _grid.find(entity.cell);
+    if (old != _grid.end())
+    {
+        old->second.erase(name);
+        if (old->second.empty())
+        {
+            _grid.erase(old);
+        }
+    }
+    _grid[cell].insert(name);
+    entity.cell = cell;
+    entity.dirty = true;
+}
+
+void ProximityEngine::forget(const std::string &name)
+{
+    auto partners = _partners.find(name);
+    if (partners == _partners.end())
+    {
+        return;
+    }
+
+    for (const auto &partner : partners->second)
+    {
+        _conflicts.erase(pairKey(name, partner));
+        unpair(partner, name);
+    }
+    _partners.erase(partners);
+}
+
+void ProximityEngine::unpair(const std::string &name, const std::string &partner)
+{
+    auto partners = _partners.find(name);
+    if (partners == _partners.end())
+    {
+        return;
+    }
+
+    partners->second.erase(partner);
+    if (partners->second.empty())
+    {
+        _partners.erase(partners);
+    }
+}
+
+std::pair<double, double> ProximityEngine::positionNow(const Entity &entity) const
+{
+    auto [lat, lon] = Player::calculateDestination(entity.lat, entity.lon, entity.bearing, entity.kph, _clockH - entity.fixH);
+    return {lat, lon};
+}
+
+ProximityAlert ProximityEngine::toAlert(const std::pair<std::string, std::string> &names, const Conflict &conflict) const
+{
+    return {names.first, names.second, std::max(0.0, conflict.cpaH - _clockH) * 60.0, conflict.dcpaKm};
+}
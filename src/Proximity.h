@@ -0,0 +1,172 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * ProximityAlert is a prediction that two entities will come within
+ * the alert distance of each other.
+ */
+class ProximityAlert
+{
+public:
+    /// @brief  the names of the two entities, in alphabetical order
+    std::string entityA;
+    std::string entityB;
+
+    /// @brief  minutes until the closest point of approach, 0 if it has passed
+    double tcpaMin = 0.0;
+
+    /// @brief  distance in kilometers at the closest point of approach
+    double dcpaKm = 0.0;
+
+    /**
+     * returns the alert as a JSON document
+     */
+    const std::string toJson() const;
+};
+
+/**
+ * ProximityEngine predicts when entities will come within alertKm of
+ * each other within the next horizonMin minutes.
+ *
+ * Each entity is assumed to keep its bearing and speed, the same model
+ * Player::travel uses.  Entities are kept in a 1 degree lat/lon grid and
+ * only pairs in nearby cells have their closest point of approach (CPA)
+ * computed.  The work is incremental: an entity is only rechecked when
+ * its cell or velocity changes, or when it has not been rechecked for
+ * half of the horizon.
+ */
+class ProximityEngine
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param alertKm alert when two entities will be closer than this
+     * @param horizonMin how far ahead, in minutes, to look for conflicts
+     */
+    ProximityEngine(const double alertKm, const double horizonMin);
+
+    /**
+     * Records an entity's position and velocity at the engine's
+     * current time.  Unknown entities are added.
+     */
+    void update(
+        const std::string &entity,
+        const double latDeg,
+        const double lonDeg,
+        const double bearingDeg,
+        const double speedKph);
+
+    /**
+     * Records an entity from a JSON document of the format:
+     *     {"name": "Tom", "lat": 1.0, "lon": 2.0, "bearing": 180.0, "kph": 250.0 }
+     * which is the format returned by Player::toJson
+     *
+     * @throws std::invalid_argument if the document can not be used,
+     * a value is out of range or it names a reserved entity
+     */
+    void update(const std::string &entityDoc);
+
+    /**
+     * Reserves an entity name, such as the local Player's, so that it
+     * can only be updated directly and not through a JSON document.
+     */
+    void reserve(const std::string &entity);
+
+    /**
+     * removes an entity and its alerts.  Entities that have not been
+     * updated for longer than the horizon are removed by check().
+     */
+    void remove(const std::string &entity);
+
+    /**
+     * advances the engine's clock
+     *
+     * @param hours the fractional number of hours
+     */
+    void advance(const double hours);
+
+    /**
+     * Rechecks the entities that have changed and returns the alerts
+     * that were raised since the previous check.
+     */
+    std::vector<ProximityAlert> check();
+
+    /**
+     * returns all of the active alerts
+     */
+    std::vector<ProximityAlert> alerts();
+
+    /**
+     * returns all of the active alerts as a JSON document
+     */
+    const std::string toJson();
+
+protected:
+    struct Entity
+    {
+        /// position at fixH
+        double lat = 0.0;
+        double lon = 0.0;
+        double fixH = 0.0;
+
+        double bearing = 0.0;
+        double kph = 0.0;
+
+        int cell = -1;
+        double checkedH = 0.0;
+        bool dirty = true;
+    };
+
+    struct Conflict
+    {
+        /// when separation is lost, when it is regained and when the entities are closest
+        double enterH = 0.0;
+        double exitH = 0.0;
+        double cpaH = 0.0;
+        double dcpaKm = 0.0;
+        bool raised = false;
+    };
+
+    std::mutex _proximityMutex;
+
+    double _alertKm;
+    double _horizonH;
+    double _clockH = 0.0;
+
+    std::unordered_map<std::string, Entity> _entities;
+    std::set<std::string> _reserved;
+
+    /// grid cell -> names of the entities in the cell
+    std::unordered_map<int, std::set<std::string>> _grid;
+
+    /// predicted conflicts keyed by the pair of entity names, in alphabetical order
+    std::map<std::pair<std::string, std::string>, Conflict> _conflicts;
+
+    /// entity name -> names of the entities it has a conflict with
+    std::unordered_map<std::string, std::set<std::string>> _partners;
+
+    /// moves an entity to a grid cell, marking it dirty if the cell changed
+    void place(const std::string &name, Entity &entity, const int cell);
+
+    /// removes an entity, its grid cell entry and its conflicts
+    void discard(const std::string &name);
+
+    /// removes every conflict that involves an entity
+    void forget(const std::string &name);
+
+    /// removes partner from name's partners, dropping the entry when it is empty
+    void unpair(const std::string &name, const std::string &partner);
+
+    /// the entity's position at the engine's current time
+    std::pair<double, double> positionNow(const Entity &entity) const;
+
+    ProximityAlert toAlert(const std::pair<std::string, std::string> &names, const Conflict &conflict) const;
+};
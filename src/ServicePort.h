@@ -9,6 +9,8 @@
 #include <fmt/core.h>
 
 #include "Player.h"
+#include "Geofence.h"
+#include "Proximity.h"
 
 class ServicePort
 {
@@ -17,6 +19,8 @@ private:
     std::string _url;
     int _port;
     Player& _player;
+    GeofenceSet& _geofences;
+    ProximityEngine& _proximity;
 
     httplib::Server svr;
     std::unique_ptr<std::thread> serverThread = nullptr;
@@ -72,6 +76,55 @@ private:
                 res.set_content(e.what(), "text/plain");
                 res.status = 400; // Bad Request
             } });
+
+        // GET returns the names of the loaded geofences
+        svr.Get("/geofences", [&g = _geofences](const httplib::Request& /*req*/, httplib::Response& res)
+        {
+            res.set_content(g.toJson(), "application/json");
+            res.status = 200; });
+
+        // POST replaces the geofences with those in a GeoJSON document
+        svr.Post("/geofences", [&g = _geofences](const httplib::Request& req, httplib::Response& res)
+        {
+            try
+            {
+                g.load(req.body);
+                res.set_content(g.toJson(), "application/json");
+                res.status = 200;
+            }
+            catch (const std::invalid_argument& e)
+            {
+                res.set_content(e.what(), "text/plain");
+                res.status = 400; // Bad Request
+            } });
+
+        // DELETE removes all of the geofences
+        svr.Delete("/geofences", [&g = _geofences](const httplib::Request& /*req*/, httplib::Response& res)
+        {
+            g.clear();
+            res.set_content(g.toJson(), "application/json");
+            res.status = 200; });
+
+        // GET returns the active proximity alerts
+        svr.Get("/alerts", [&e = _proximity](const httplib::Request& /*req*/, httplib::Response& res)
+        {
+            res.set_content(e.toJson(), "application/json");
+            res.status = 200; });
+
+        // POST reports another entity's position and velocity for proximity alerting
+        svr.Post("/entities", [&e = _proximity](const httplib::Request& req, httplib::Response& res)
+        {
+            try
+            {
+                e.update(req.body);
+                res.set_content(e.toJson(), "application/json");
+                res.status = 200;
+            }
+            catch (const std::invalid_argument& ex)
+            {
+                res.set_content(ex.what(), "text/plain");
+                res.status = 400; // Bad Request
+            } });
     }
 
 public:
@@ -82,6 +135,10 @@ public:
      * A GET request sent to the URL/Port returns a JSON representation of
      * the Player's current state
      * A POST request with an JSON body updates the Player's velocity vector.
+     * A POST request to /geofences with a GeoJSON body replaces the
+     * geofences, a GET lists them and a DELETE removes them.
+     * A POST request to /entities with a JSON body reports another entity
+     * for proximity alerting and a GET to /alerts returns the active alerts.
      *
      * @param url the url of the network interface that will accept
      * connections.  Values include:
@@ -94,9 +151,11 @@ public:
      * interfaces on the container/host this server it running on
      * @param port the port that will be listend to
      * @param player a reference to the Player that will served
+     * @param geofences a reference to the geofences the Player is checked against
+     * @param proximity a reference to the proximity engine the Player is checked in
      */
-    inline ServicePort(const std::string url, const int port, Player& player)
-        : _url(url), _port(port), _player(player)
+    inline ServicePort(const std::string url, const int port, Player& player, GeofenceSet& geofences, ProximityEngine& proximity)
+        : _url(url), _port(port), _player(player), _geofences(geofences), _proximity(proximity)
     {
     }
 
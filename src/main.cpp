@@ -6,6 +6,8 @@
 #include <thread>
 
 #include "Player.h"
+#include "Geofence.h"
+#include "Proximity.h"
 #include "ServicePort.h"
 
 std::string getEnvString(std::string name, std::string defaultVal)
@@ -59,6 +61,10 @@ int main()
         double bearing = getEnvDouble("PLAYER_BEARING_DEG", 90.0);
         double rate = getEnvDouble("PLAYER_RATE", 150.0);
 
+        // proximity alerting
+        double alertKm = getEnvDouble("PLAYER_ALERT_KM", 5.0);
+        double alertMinutes = getEnvDouble("PLAYER_ALERT_MINUTES", 10.0);
+
         if (lat < -90.0 || lat > 90.0)
         {
             throw std::out_of_range(fmt::format("Latitude value ({}) is out of range. It must be in the range (-90.0 , 90.0)", lat));
@@ -79,11 +85,25 @@ int main()
             throw std::out_of_range(fmt::format("Rate value ({}) is out of range.  It must be greater than or equal to 0.", bearing));
         }
 
+        if (alertKm <= 0.0)
+        {
+            throw std::out_of_range(fmt::format("Alert distance ({}) is out of range.  It must be greater than 0.", alertKm));
+        }
+
+        if (alertMinutes <= 0.0)
+        {
+            throw std::out_of_range(fmt::format("Alert time ({}) is out of range.  It must be greater than 0.", alertMinutes));
+        }
+
         Player p(playerName, lat, lon, alt, bearing, rate);
         fmt::println("{}", p.toString());
 
+        GeofenceSet geofences;
+        ProximityEngine proximity(alertKm, alertMinutes);
+        proximity.reserve(p.name);
+
         // start on 0.0.0.0 - 'localhost' does not work inside docker containers.
-        ServicePort server("0.0.0.0", 8080, p);
+        ServicePort server("0.0.0.0", 8080, p, geofences, proximity);
         server.StartServer();
 
         // event loop to update the player location
@@ -97,9 +117,24 @@ int main()
 
             int sec = std::chrono::duration_cast<std::chrono::nanoseconds>(deltaTime).count();
             double hours = sec / (3600.0 * 1e9);
+            double prevLat = p.lat;
+            double prevLon = p.lon;
             p.travel(hours);
 
             fmt::println("{}", p.toGeoJSON());
+            for (const auto &event : geofences.update(p.name, prevLat, prevLon, p.lat, p.lon))
+            {
+                fmt::println("{}", event.toGeoJSON());
+            }
+
+            // the velocity can be changed by the service port while the loop runs
+            auto [nowLat, nowLon, nowBearing, nowKph] = p.snapshot();
+            proximity.advance(hours);
+            proximity.update(p.name, nowLat, nowLon, nowBearing, nowKph);
+            for (const auto &alert : proximity.check())
+            {
+                fmt::println("{}", alert.toJson());
+            }
             std::this_thread::sleep_for(std::chrono::seconds(updateRate)); 
         }
     }
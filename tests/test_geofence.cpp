@@ -0,0 +1,183 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <stdexcept>
+#include "Geofence.h"
+
+TEST_CASE("Geofence", "[geofence]")
+{
+    SECTION("PolygonContains")
+    {
+        Geofence fence = Geofence::polygon("Box", {{0.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}, {1.0, 0.0}, {0.0, 0.0}});
+        REQUIRE(fence.vertices.size() == 4);
+        REQUIRE(fence.contains(0.5, 0.5));
+        REQUIRE_FALSE(fence.contains(1.5, 0.5));
+        REQUIRE_FALSE(fence.contains(0.5, -0.5));
+    }
+
+    SECTION("PolygonCrossingAntiMeridian")
+    {
+        Geofence fence = Geofence::polygon("Dateline", {{-1.0, 179.0}, {-1.0, -179.0}, {1.0, -179.0}, {1.0, 179.0}});
+        REQUIRE(fence.contains(0.0, 179.5));
+        REQUIRE(fence.contains(0.0, -179.5));
+        REQUIRE(fence.contains(0.0, 180.0));
+        REQUIRE_FALSE(fence.contains(0.0, 0.0));
+        REQUIRE_FALSE(fence.contains(0.0, 178.5));
+    }
+
+    SECTION("Circle")
+    {
+        Geofence fence = Geofence::circle("Ring", 0.0, 180.0, 100.0);
+        REQUIRE(fence.contains(0.0, 179.5));
+        REQUIRE(fence.contains(0.0, -179.5));
+        REQUIRE_FALSE(fence.contains(0.0, 178.0));
+        REQUIRE(fence.intersects(0.0, 178.0, 0.0, -178.0));
+        REQUIRE_FALSE(fence.intersects(2.0, 178.0, 2.0, -178.0));
+    }
+
+    SECTION("Invalid")
+    {
+        REQUIRE_THROWS_AS(Geofence::polygon("Line", {{0.0, 0.0}, {1.0, 1.0}}), std::invalid_argument);
+        REQUIRE_THROWS_AS(Geofence::circle("Dot", 0.0, 0.0, 0.0), std::invalid_argument);
+    }
+}
+
+TEST_CASE("GeofenceSet", "[geofence]")
+{
+    SECTION("EnterAndExit")
+    {
+        GeofenceSet fences;
+        fences.add(Geofence::polygon("Box", {{0.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}, {1.0, 0.0}}));
+
+        REQUIRE(fences.update("Bob", -0.5, 0.5, -0.1, 0.5).empty());
+
+        auto enter = fences.update("Bob", -0.1, 0.5, 0.1, 0.5);
+        REQUIRE(enter.size() == 1);
+        REQUIRE(enter[0].type == "enter");
+        REQUIRE(enter[0].fence == "Box");
+        REQUIRE(enter[0].entity == "Bob");
+        REQUIRE(enter[0].lat == Catch::Approx(0.0).margin(0.0001));
+        REQUIRE(enter[0].lon == Catch::Approx(0.5).margin(0.0001));
+
+        REQUIRE(fences.update("Bob", 0.1, 0.5, 0.9, 0.5).empty());
+
+        auto exit = fences.update("Bob", 0.9, 0.5, 1.1, 0.5);
+        REQUIRE(exit.size() == 1);
+        REQUIRE(exit[0].type == "exit");
+        REQUIRE(exit[0].lat == Catch::Approx(1.0).margin(0.0001));
+    }
+
+    SECTION("FastEnter")
+    {
+        GeofenceSet fences;
+        fences.add(Geofence::polygon("Box", {{0.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}, {1.0, 0.0}}));
+
+        auto enter = fences.update("Fast", -5.0, 0.5, 0.9, 0.5);
+        REQUIRE(enter.size() == 1);
+        REQUIRE(enter[0].type == "enter");
+        REQUIRE(enter[0].lat == Catch::Approx(0.0).margin(0.0001));
+        REQUIRE(enter[0].lon == Catch::Approx(0.5).margin(0.0001));
+    }
+
+    SECTION("AcrossConcaveGap")
+    {
+        // a "U" open to the north, with arms at longitudes 0-1 and 2-3
+        GeofenceSet fences;
+        fences.add(Geofence::polygon("U", {{0.0, 0.0}, {0.0, 3.0}, {3.0, 3.0}, {3.0, 2.0}, {1.0, 2.0}, {1.0, 1.0}, {3.0, 1.0}, {3.0, 0.0}}));
+        REQUIRE(fences.update("Fast", 2.0, -0.5, 2.0, 0.5).size() == 1);
+
+        // from one arm across the gap into the other
+        auto events = fences.update("Fast", 2.0, 0.5, 2.0, 2.5);
+        REQUIRE(events.size() == 2);
+        REQUIRE(events[0].type == "exit");
+        REQUIRE(events[0].lon == Catch::Approx(1.0).margin(0.0001));
+        REQUIRE(events[1].type == "enter");
+        REQUIRE(events[1].lon == Catch::Approx(2.0).margin(0.0001));
+    }
+
+    SECTION("PassThrough")
+    {
+        GeofenceSet fences;
+        fences.add(Geofence::polygon("Box", {{0.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}, {1.0, 0.0}}));
+
+        auto events = fences.update("Fast", -5.0, 0.5, 5.0, 0.5);
+        REQUIRE(events.size() == 2);
+        REQUIRE(events[0].type == "enter");
+        REQUIRE(events[0].lat == Catch::Approx(0.0).margin(0.0001));
+        REQUIRE(events[0].lon == Catch::Approx(0.5).margin(0.0001));
+        REQUIRE(events[1].type == "exit");
+        REQUIRE(events[1].lat == Catch::Approx(1.0).margin(0.0001));
+        REQUIRE(events[1].lon == Catch::Approx(0.5).margin(0.0001));
+    }
+
+    SECTION("PassThroughCircleAcrossAntiMeridian")
+    {
+        GeofenceSet fences;
+        fences.add(Geofence::circle("Ring", 0.0, 180.0, 111.19493));
+
+        auto events = fences.update("Fast", 0.0, 178.0, 0.0, -178.0);
+        REQUIRE(events.size() == 2);
+        REQUIRE(events[0].type == "enter");
+        REQUIRE(events[0].lat == Catch::Approx(0.0).margin(0.0001));
+        REQUIRE(events[0].lon == Catch::Approx(179.0).margin(0.0001));
+        REQUIRE(events[1].type == "exit");
+        REQUIRE(events[1].lon == Catch::Approx(-179.0).margin(0.0001));
+    }
+
+    SECTION("AddReplacesByName")
+    {
+        GeofenceSet fences;
+        fences.add(Geofence::polygon("Box", {{0.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}, {1.0, 0.0}}));
+        fences.add(Geofence::polygon("Box", {{10.0, 10.0}, {10.0, 11.0}, {11.0, 11.0}, {11.0, 10.0}}));
+        REQUIRE(fences.size() == 1);
+
+        REQUIRE(fences.update("Bob", -0.1, 0.5, 0.5, 0.5).empty());
+        REQUIRE(fences.update("Bob", 9.9, 10.5, 10.5, 10.5).size() == 1);
+    }
+
+    SECTION("RemoveForgetsEntity")
+    {
+        GeofenceSet fences;
+        fences.add(Geofence::circle("Ring", 0.0, 0.0, 50.0));
+        REQUIRE(fences.update("Bob", 0.0, -1.0, 0.0, 0.0).size() == 1);
+
+        // a removed entity starts over as if it was outside every fence
+        fences.remove("Bob");
+        auto events = fences.update("Bob", 0.0, 0.0, 0.0, 0.0);
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0].type == "enter");
+    }
+
+    SECTION("AcrossAntiMeridian")
+    {
+        GeofenceSet fences;
+        fences.add(Geofence::polygon("Dateline", {{-1.0, 179.0}, {-1.0, -179.0}, {1.0, -179.0}, {1.0, 179.0}}));
+
+        auto enter = fences.update("Bob", 0.0, 178.5, 0.0, 179.5);
+        REQUIRE(enter.size() == 1);
+        REQUIRE(enter[0].type == "enter");
+
+        REQUIRE(fences.update("Bob", 0.0, 179.5, 0.0, -179.5).empty());
+
+        auto exit = fences.update("Bob", 0.0, -179.5, 0.0, -178.5);
+        REQUIRE(exit.size() == 1);
+        REQUIRE(exit[0].type == "exit");
+    }
+
+    SECTION("ClearExitsEntities")
+    {
+        GeofenceSet fences;
+        fences.add(Geofence::circle("Ring", 0.0, 0.0, 50.0));
+        REQUIRE(fences.update("Bob", 0.0, -1.0, 0.0, 0.0).size() == 1);
+
+        fences.clear();
+        REQUIRE(fences.size() == 0);
+
+        // the exit is reported on the next update, at the previous position
+        auto events = fences.update("Bob", 0.0, 0.0, 0.0, 1.0);
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0].type == "exit");
+        REQUIRE(events[0].fence == "Ring");
+        REQUIRE(events[0].lon == Catch::Approx(0.0).margin(0.0001));
+        REQUIRE(fences.update("Bob", 0.0, 1.0, 0.0, 2.0).empty());
+    }
+}
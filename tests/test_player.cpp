@@ -31,6 +31,16 @@ TEST_CASE("Player", "[constructor]")
         REQUIRE(p.bearing == Catch::Approx(expected_bearing).margin(0.01));
         REQUIRE(p.kph == Catch::Approx(expected_kph).margin(0.01));
     }
+    SECTION("Snapshot")
+    {
+        Player p("Fruit", 1.0, 2.0, 3.0, 4.0, 100);
+
+        auto [lat, lon, bearing, kph] = p.snapshot();
+        REQUIRE(lat == Catch::Approx(1.0).margin(0.01));
+        REQUIRE(lon == Catch::Approx(2.0).margin(0.01));
+        REQUIRE(bearing == Catch::Approx(4.0).margin(0.01));
+        REQUIRE(kph == Catch::Approx(100.0).margin(0.01));
+    }
 }
 
 TEST_CASE("Player Movement", "[movement]")
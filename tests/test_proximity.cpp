@@ -0,0 +1,164 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <stdexcept>
+#include "Player.h"
+#include "Proximity.h"
+
+TEST_CASE("ProximityEngine", "[proximity]")
+{
+    SECTION("HeadOn")
+    {
+        // 20 km apart on the equator, closing at 240 kph
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 0.0, 90.0, 120.0);
+        engine.update("Tom", 0.0, 0.17986, 270.0, 120.0);
+
+        auto alerts = engine.check();
+        REQUIRE(alerts.size() == 1);
+        REQUIRE(alerts[0].entityA == "Bob");
+        REQUIRE(alerts[0].entityB == "Tom");
+        REQUIRE(alerts[0].tcpaMin == Catch::Approx(5.0).margin(0.01));
+        REQUIRE(alerts[0].dcpaKm == Catch::Approx(0.0).margin(0.01));
+
+        // an alert is only raised once
+        engine.advance(1.0 / 60.0);
+        REQUIRE(engine.check().empty());
+        REQUIRE(engine.alerts().size() == 1);
+        REQUIRE(engine.alerts()[0].tcpaMin == Catch::Approx(4.0).margin(0.01));
+    }
+
+    SECTION("Formation")
+    {
+        // 2.2 km apart with the same velocity, the conflict never ends
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 0.0, 90.0, 120.0);
+        engine.update("Tom", 0.02, 0.0, 90.0, 120.0);
+        REQUIRE(engine.check().size() == 1);
+
+        for (int minute = 1; minute <= 20; minute++)
+        {
+            engine.advance(1.0 / 60.0);
+            auto [bobLat, bobLon] = Player::calculateDestination(0.0, 0.0, 90.0, 120.0, minute / 60.0);
+            auto [tomLat, tomLon] = Player::calculateDestination(0.02, 0.0, 90.0, 120.0, minute / 60.0);
+            engine.update("Bob", bobLat, bobLon, 90.0, 120.0);
+            engine.update("Tom", tomLat, tomLon, 90.0, 120.0);
+
+            // not raised again, but still active
+            REQUIRE(engine.check().empty());
+            REQUIRE(engine.alerts().size() == 1);
+        }
+    }
+
+    SECTION("DivergingInside")
+    {
+        // 2.2 km apart and separating at 240 kph, separation is regained after 0.7 minutes
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 0.0, 270.0, 120.0);
+        engine.update("Tom", 0.0, 0.02, 90.0, 120.0);
+
+        auto alerts = engine.check();
+        REQUIRE(alerts.size() == 1);
+        REQUIRE(alerts[0].tcpaMin == Catch::Approx(0.0).margin(0.01));
+
+        engine.advance(0.5 / 60.0);
+        REQUIRE(engine.check().empty());
+        REQUIRE(engine.alerts().size() == 1);
+
+        engine.advance(0.5 / 60.0);
+        REQUIRE(engine.check().empty());
+        REQUIRE(engine.alerts().empty());
+    }
+
+    SECTION("Parallel")
+    {
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 0.0, 90.0, 120.0);
+        engine.update("Tom", 0.1, 0.0, 90.0, 120.0);
+        REQUIRE(engine.check().empty());
+    }
+
+    SECTION("BeyondHorizon")
+    {
+        // 60 km apart closing at 240 kph, a conflict 15 minutes away
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 0.0, 90.0, 120.0);
+        engine.update("Tom", 0.0, 0.53959, 270.0, 120.0);
+        REQUIRE(engine.check().empty());
+
+        // neither changes cell or velocity but the conflict comes into the horizon
+        engine.advance(4.0 / 60.0);
+        REQUIRE(engine.check().size() == 1);
+    }
+
+    SECTION("AcrossAntiMeridian")
+    {
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 179.95, 90.0, 120.0);
+        engine.update("Tom", 0.0, -179.95, 270.0, 120.0);
+        REQUIRE(engine.check().size() == 1);
+    }
+
+    SECTION("VelocityChangeClearsAlert")
+    {
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 0.0, 90.0, 120.0);
+        engine.update("Tom", 0.0, 0.17986, 270.0, 120.0);
+        REQUIRE(engine.check().size() == 1);
+
+        engine.update("Tom", 0.0, 0.17986, 90.0, 120.0);
+        REQUIRE(engine.check().empty());
+        REQUIRE(engine.alerts().empty());
+    }
+
+    SECTION("StaleEntityExpires")
+    {
+        // Tom stops reporting while flying in formation with Bob
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 0.0, 90.0, 120.0);
+        engine.update("Tom", 0.02, 0.0, 90.0, 120.0);
+        REQUIRE(engine.check().size() == 1);
+
+        for (int minute = 1; minute <= 11; minute++)
+        {
+            engine.advance(1.0 / 60.0);
+            auto [bobLat, bobLon] = Player::calculateDestination(0.0, 0.0, 90.0, 120.0, minute / 60.0);
+            engine.update("Bob", bobLat, bobLon, 90.0, 120.0);
+            engine.check();
+
+            if (minute == 9)
+            {
+                REQUIRE(engine.alerts().size() == 1);
+            }
+        }
+        REQUIRE(engine.alerts().empty());
+    }
+
+    SECTION("Reserved")
+    {
+        ProximityEngine engine(5.0, 10.0);
+        engine.reserve("Bob");
+        REQUIRE_THROWS_AS(engine.update(R"({"name": "Bob", "lat": 0.0, "lon": 0.0, "bearing": 90.0, "kph": 120.0})"), std::invalid_argument);
+        REQUIRE_NOTHROW(engine.update(R"({"name": "Tom", "lat": 0.0, "lon": 0.0, "bearing": 90.0, "kph": 120.0})"));
+    }
+
+    SECTION("OutOfRange")
+    {
+        ProximityEngine engine(5.0, 10.0);
+        REQUIRE_THROWS_AS(engine.update(R"({"name": "Tom", "lat": 0.0, "lon": 0.0, "bearing": 270.0, "kph": -600.0})"), std::invalid_argument);
+        REQUIRE_THROWS_AS(engine.update(R"({"name": "Tom", "lat": 0.0, "lon": 0.0, "bearing": 360.0, "kph": 600.0})"), std::invalid_argument);
+        REQUIRE_THROWS_AS(engine.update(R"({"name": "Tom", "lat": 0.0, "lon": 200.0, "bearing": 90.0, "kph": 600.0})"), std::invalid_argument);
+        REQUIRE_THROWS_AS(engine.update(R"({"name": "Tom", "lat": 91.0, "lon": 0.0, "bearing": 90.0, "kph": 600.0})"), std::invalid_argument);
+        REQUIRE(engine.alerts().empty());
+    }
+
+    SECTION("Remove")
+    {
+        ProximityEngine engine(5.0, 10.0);
+        engine.update("Bob", 0.0, 0.0, 90.0, 120.0);
+        engine.update("Tom", 0.0, 0.17986, 270.0, 120.0);
+        REQUIRE(engine.check().size() == 1);
+
+        engine.remove("Tom");
+        REQUIRE(engine.alerts().empty());
+    }
+}